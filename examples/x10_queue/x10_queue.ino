@@ -0,0 +1,63 @@
+/*
+  X10 queue
+
+  Loads the transmit queue with a burst of bulk traffic and an urgent
+  command, then prints how many frames went out and how long each
+  priority waited.  Lights A1-A8 are switched on and off several times,
+  so only the last ON or OFF for each one is sent and the units are
+  grouped, up to X10_QUEUE_BATCH at a time, into address lists each
+  followed by one function frame.
+
+  The A-16 "alarm" is queued last but sent first.
+*/
+
+#include <x10.h>
+#include <x10constants.h>
+#include <x10queue.h>
+
+#define zcPin 2         // the zero crossing detect pin
+#define dataPin 3       // the X10 data out pin
+#define repeatTimes 2   // how many times each X10 message should repeat
+
+x10 myHouse;
+x10queue queue(myHouse);
+
+void setup() {
+  Serial.begin(57600);
+  myHouse.init(zcPin, dataPin);
+  Serial.println(myHouse.version());
+}
+
+void loop() {
+  // bulk traffic - each unit toggled a few times before anything is sent
+  for (byte pass = 0; pass < 3; pass++) {
+    for (byte unit = 1; unit <= 8; unit++) {
+      queue.add(HOUSE_A, unit, (pass & 1) ? OFF : ON, repeatTimes, X10_PRIORITY_LOW);
+    }
+  }
+  queue.add(HOUSE_B, 1, DIM, 10, X10_PRIORITY_LOW);
+  queue.add(HOUSE_B, 2, DIM, 10, X10_PRIORITY_LOW);
+  // urgent command
+  queue.add(HOUSE_A, 16, ON, repeatTimes, X10_PRIORITY_HIGH);
+
+  Serial.print("Queued           : ");
+  Serial.println(queue.depth());
+  queue.flush();
+
+  Serial.print("Frames sent      : ");
+  Serial.println(queue.framesSent());
+  Serial.print("Superseded       : ");
+  Serial.println(queue.superseded());
+  Serial.print("Coalesced        : ");
+  Serial.println(queue.coalesced());
+  Serial.print("Max depth        : ");
+  Serial.println(queue.maxDepth());
+  Serial.print("High max wait ms : ");
+  Serial.println(queue.maxWait(X10_PRIORITY_HIGH));
+  Serial.print("Low max wait ms  : ");
+  Serial.println(queue.maxWait(X10_PRIORITY_LOW));
+  Serial.print("Low avg wait ms  : ");
+  Serial.println(queue.avgWait(X10_PRIORITY_LOW));
+  queue.resetStats();
+  delay(5000);
+}
@@ -0,0 +1,17 @@
+/*
+	Arduino.h - Host stand-in for the parts of the Arduino core used by
+	the pin-free parts of the library.  The test provides millis().
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis(void);
+
+#endif
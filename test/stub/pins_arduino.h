@@ -0,0 +1,3 @@
+/*
+	pins_arduino.h - Empty host stand-in, x10.h includes it.
+*/
@@ -0,0 +1,89 @@
+/*
+  x10codec_fuzz.cpp - Fuzz target for the receive decoder.
+
+	Each input byte is eight half cycles, MSB first, a set bit meaning
+	carrier was seen.  The decoder is driven exactly as Check_Rcvr() drives
+	it and its state is checked after every step.  A frame in progress
+	must take a bit at least every MAX_STALL + 1 zero crossings and end
+	within X10_FRAME_HALF_CYCLES of its start bit.  Once the input ends
+	the line goes quiet, and the decoder must be idle again within a
+	frame's worth of half cycles.
+
+	Built with -fsanitize=fuzzer this is a libFuzzer target.  Otherwise
+	x10codec_fuzz_main.cpp runs it over a fixed set of pseudo random
+	inputs.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "x10codec.h"
+
+#define QUIET_HALF_CYCLES	(X10_FRAME_HALF_CYCLES + 2)
+
+#define FUZZ_ASSERT(cond) do { if (!(cond)) { \
+		fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond); \
+		abort(); } } while (0)
+
+static void checkState(const x10_rx *rx)
+{
+	FUZZ_ASSERT(rx->bits < X10_FRAME_BITS);
+	FUZZ_ASSERT(rx->skip <= 1);
+	FUZZ_ASSERT((rx->frame >> X10_FRAME_BITS) == 0);
+	if (rx->bits > 0) {
+		FUZZ_ASSERT(rx->skip == 0);
+		FUZZ_ASSERT(rx->frame & (1 << (X10_FRAME_BITS - 1)));	// start bit
+		// a frame lasts 22 half cycles
+		FUZZ_ASSERT(rx->zeroCrossings < X10_FRAME_HALF_CYCLES);
+	}
+	if (rx->bits >= 4) { FUZZ_ASSERT(x10_frameStart(rx->frame) == X10_START_CODE); }
+}
+
+// Most zero crossings a frame in progress may go without taking a bit:
+// after the start code every other half cycle is a complement.
+#define MAX_STALL	1
+
+struct progress {
+	unsigned frames;
+	unsigned stall;			// crossings since bits last changed mid-frame
+};
+
+// One zero crossing.  The decoder functions have no loops, so each call is
+// constant time; what is bounded here is how long the decoder can stay in
+// a frame without moving it on.
+static void halfCycle(x10_rx *rx, bool carrier, progress *p)
+{
+	uint8_t bits = rx->bits;
+
+	if (x10_rxZeroCross(rx) && x10_rxSample(rx, carrier)) {
+		p->frames++;
+		FUZZ_ASSERT(x10_frameStart(rx->frame) == X10_START_CODE);
+	}
+	checkState(rx);
+	if (rx->bits != 0 && rx->bits == bits) {
+		p->stall++;
+		FUZZ_ASSERT(p->stall <= MAX_STALL);
+	} else {
+		p->stall = 0;
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	x10_rx rx;
+	progress p = { 0, 0 };
+	size_t halfCycles = size * 8;
+
+	x10_rxReset(&rx);
+	for (size_t i = 0; i < halfCycles; i++) {
+		halfCycle(&rx, (data[i / 8] >> (7 - i % 8)) & 1, &p);
+	}
+	FUZZ_ASSERT(p.frames <= halfCycles / X10_FRAME_HALF_CYCLES);
+
+	// quiet line - any frame in progress completes or is dropped
+	for (int i = 0; i < QUIET_HALF_CYCLES; i++) {
+		halfCycle(&rx, false, &p);
+	}
+	FUZZ_ASSERT(rx.bits == 0 && rx.skip == 0);
+	return 0;
+}
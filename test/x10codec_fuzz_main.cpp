@@ -0,0 +1,95 @@
+/*
+  x10codec_fuzz_main.cpp - Deterministic driver for the decoder fuzz target.
+
+	Used when libFuzzer is not available.  With file arguments each file is
+	run as one input, so a crash found by libFuzzer can be replayed.
+	Without arguments a fixed seed generates random streams and valid
+	streams with bits flipped, so every run covers the same inputs.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "x10codec.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define RUNS		200000
+#define MAX_INPUT	128
+
+static uint32_t seed = 0x2545F491;
+
+static uint32_t next(void)		// xorshift32
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+// Packs repeats of a valid frame into bytes, one bit per half cycle.
+static size_t validStream(uint8_t *data, size_t max)
+{
+	size_t bit = 0;
+
+	memset(data, 0, max);
+	while (bit + X10_FRAME_HALF_CYCLES + 6 <= max * 8) {
+		uint32_t frame = x10_encodeFrame(next() & 0x0F, next() & 0x1F);
+		int repeats = 1 + next() % 3;
+		for (int r = 0; r < repeats && bit + X10_FRAME_HALF_CYCLES <= max * 8; r++) {
+			for (int i = X10_FRAME_HALF_CYCLES - 1; i >= 0; i--, bit++) {
+				if ((frame >> i) & 1) { data[bit / 8] |= 0x80 >> (bit % 8); }
+			}
+		}
+		bit += next() % 8;			// gap
+	}
+	if (bit > max * 8) { bit = max * 8; }
+	return (bit + 7) / 8;
+}
+
+static int runFile(const char *path)
+{
+	static uint8_t data[1 << 16];
+	FILE *f = fopen(path, "rb");
+
+	if (!f) {
+		perror(path);
+		return 1;
+	}
+	size_t size = fread(data, 1, sizeof(data), f);
+	fclose(f);
+	LLVMFuzzerTestOneInput(data, size);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t data[MAX_INPUT];
+
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++) {
+			if (runFile(argv[i])) return 1;
+		}
+		return 0;
+	}
+
+	memset(data, 0x00, sizeof(data));
+	LLVMFuzzerTestOneInput(data, sizeof(data));
+	memset(data, 0xFF, sizeof(data));
+	LLVMFuzzerTestOneInput(data, sizeof(data));
+	for (int run = 0; run < RUNS; run++) {
+		size_t size = next() % (MAX_INPUT + 1);
+		if (run & 1) {
+			for (size_t i = 0; i < size; i++) { data[i] = next(); }
+		} else {
+			size = validStream(data, MAX_INPUT);
+			for (int flips = next() % 4; flips > 0; flips--) {
+				uint32_t bit = next() % (size * 8);
+				data[bit / 8] ^= 0x80 >> (bit % 8);
+			}
+		}
+		LLVMFuzzerTestOneInput(data, size);
+	}
+	printf("x10codec_fuzz: %d inputs passed\n", RUNS + 2);
+	return 0;
+}
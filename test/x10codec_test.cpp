@@ -0,0 +1,139 @@
+/*
+  x10codec_test.cpp - Round trip property test for the frame codec.
+
+	Every house code, unit or function code and repeat count is encoded,
+	sent half cycle by half cycle the way x10::write() puts it on the line
+	(repeats back to back, then a 6 zero crossing gap unless the code is
+	DIM or BRIGHT) and fed to the decoder, which must hand back exactly one
+	matching frame per repeat and end up idle.
+*/
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "x10constants.h"
+#include "x10codec.h"
+
+#define MAX_REPEATS	8
+#define GAP			6		// zero crossings after a non DIM/BRIGHT write
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+		printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+		failures++; } } while (0)
+
+struct decoded {
+	int frames;
+	int bad;				// frames that did not match
+};
+
+static void halfCycle(x10_rx *rx, bool carrier, uint8_t houseCode, uint8_t code, decoded *d)
+{
+	if (!x10_rxZeroCross(rx)) return;
+	if (!x10_rxSample(rx, carrier)) return;
+	d->frames++;
+	if (x10_frameStart(rx->frame) != X10_START_CODE ||
+			x10_frameHouse(rx->frame) != houseCode ||
+			x10_frameCode(rx->frame) != code ||
+			x10_frameIsFunction(rx->frame) != (code & 1)) {
+		d->bad++;
+	}
+}
+
+// Same line activity as x10::write(houseCode, code, repeats).
+static void write(x10_rx *rx, uint8_t houseCode, uint8_t code, int repeats, decoded *d)
+{
+	uint32_t frame = x10_encodeFrame(houseCode, code);
+
+	for (int r = 0; r < repeats; r++) {
+		for (int i = X10_FRAME_HALF_CYCLES - 1; i >= 0; i--) {
+			halfCycle(rx, (frame >> i) & 1, houseCode, code, d);
+		}
+	}
+	if (code != DIM && code != BRIGHT) {
+		for (int i = 0; i < GAP; i++) { halfCycle(rx, false, houseCode, code, d); }
+	}
+}
+
+static void testEncode(void)
+{
+	for (int house = 0; house < 16; house++) {
+		for (int code = 0; code < 32; code++) {
+			uint32_t frame = x10_encodeFrame(house, code);
+			CHECK((frame >> X10_FRAME_HALF_CYCLES) == 0);
+			CHECK((frame >> 18) == X10_START_CODE);
+			// every bit after the start code is followed by its complement
+			for (int i = 0; i < 9; i++) {
+				CHECK(((frame >> (2 * i + 1)) & 1) != ((frame >> (2 * i)) & 1));
+			}
+		}
+	}
+}
+
+static void testRoundTrip(void)
+{
+	for (int house = 0; house < 16; house++) {
+		for (int code = 0; code < 32; code++) {
+			for (int repeats = 1; repeats <= MAX_REPEATS; repeats++) {
+				x10_rx rx;
+				decoded d = { 0, 0 };
+
+				x10_rxReset(&rx);
+				write(&rx, house, code, repeats, &d);
+				CHECK(d.frames == repeats);
+				CHECK(d.bad == 0);
+				CHECK(rx.bits == 0);
+				CHECK(rx.skip == 0);
+				if (d.frames != repeats || d.bad) {
+					printf("  house %d code %d repeats %d: %d frames, %d bad\n",
+						house, code, repeats, d.frames, d.bad);
+				}
+			}
+		}
+	}
+}
+
+// DIM and BRIGHT writes have no gap, so the next write follows at once.
+static void testBackToBackWrites(void)
+{
+	for (int house = 0; house < 16; house++) {
+		for (int repeats = 1; repeats <= MAX_REPEATS; repeats++) {
+			x10_rx rx;
+			decoded d = { 0, 0 };
+
+			x10_rxReset(&rx);
+			write(&rx, house, DIM, repeats, &d);
+			write(&rx, house, DIM, repeats, &d);
+			write(&rx, house, BRIGHT, 1, &d);
+			CHECK(d.frames == 2 * repeats + 1);
+			CHECK(rx.bits == 0);
+		}
+	}
+	// an address frame followed straight away by its function frame
+	for (int house = 0; house < 16; house++) {
+		for (int unit = 0; unit < 32; unit += 2) {
+			x10_rx rx;
+			decoded unitFrames = { 0, 0 };
+			decoded functionFrames = { 0, 0 };
+
+			x10_rxReset(&rx);
+			write(&rx, house, unit, 2, &unitFrames);
+			write(&rx, house, DIM, 2, &functionFrames);
+			CHECK(unitFrames.frames == 2 && unitFrames.bad == 0);
+			CHECK(functionFrames.frames == 2 && functionFrames.bad == 0);
+		}
+	}
+}
+
+int main(void)
+{
+	testEncode();
+	testRoundTrip();
+	testBackToBackWrites();
+	if (failures) {
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("x10codec: all tests passed\n");
+	return 0;
+}
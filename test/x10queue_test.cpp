@@ -0,0 +1,371 @@
+/*
+  x10queue_test.cpp - Host test for the transmit queue.
+
+	The modem is replaced by a stub that records each write() and moves a
+	fake millis() clock on by the time the frames take on a 60Hz line, so
+	frame counts and wait times can be checked without hardware.
+*/
+
+#include <stdio.h>
+#include "x10.h"
+#include "x10queue.h"
+#include "x10constants.h"
+
+#define FRAME_MS	183		// 22 half cycles at 60Hz
+#define GAP_MS		50		// 6 zero crossings after a non DIM/BRIGHT frame
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+		printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+		failures++; } } while (0)
+
+// Stub clock and modem:
+
+static unsigned long now = 0;
+
+unsigned long millis(void)
+{
+	return now;
+}
+
+struct written {
+	byte houseCode;
+	byte code;
+	int numRepeats;
+};
+
+static written writes[512];
+static int writeCount = 0;
+static unsigned long wireFrames = 0;
+static unsigned long wireAddressFrames = 0;
+static unsigned long wireDimWrites = 0;
+static void (*onWrite)(void) = 0;	// called as each write starts, may add()
+
+x10::x10() {}
+
+void x10::write(byte houseCode, byte numberCode, int numRepeats)
+{
+	if (writeCount < 512) {
+		writes[writeCount].houseCode = houseCode;
+		writes[writeCount].code = numberCode;
+		writes[writeCount].numRepeats = numRepeats;
+	}
+	writeCount++;
+	wireFrames += numRepeats;
+	if (!(numberCode & 1)) { wireAddressFrames += numRepeats; }
+	if (numberCode == DIM) { wireDimWrites++; }
+	// a command added now arrives while this write is on the wire
+	if (onWrite) { onWrite(); }
+	now += (unsigned long)numRepeats * FRAME_MS;
+	if (numberCode != DIM && numberCode != BRIGHT) { now += GAP_MS; }
+}
+
+static void resetModem(void)
+{
+	now = 0;
+	writeCount = 0;
+	wireFrames = 0;
+	wireAddressFrames = 0;
+	wireDimWrites = 0;
+	onWrite = 0;
+}
+
+static const byte houses[16] = {
+	HOUSE_A, HOUSE_B, HOUSE_C, HOUSE_D, HOUSE_E, HOUSE_F, HOUSE_G, HOUSE_H,
+	HOUSE_I, HOUSE_J, HOUSE_K, HOUSE_L, HOUSE_M, HOUSE_N, HOUSE_O, HOUSE_P
+};
+
+// Tests:
+
+static void testSupersede(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	CHECK(q.add(HOUSE_A, 1, ON, 2));
+	CHECK(q.add(HOUSE_A, 1, OFF, 2));
+	CHECK(q.depth() == 1);
+	CHECK(q.superseded() == 1);
+	q.flush();
+	CHECK(writeCount == 2);
+	CHECK(writes[0].code == UNIT_1);
+	CHECK(writes[1].code == OFF);
+	CHECK(q.framesSent() == 4);
+	CHECK(q.framesSent() == wireFrames);
+}
+
+static void testCoalesce(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte unit = 1; unit <= 4; unit++) { CHECK(q.add(HOUSE_A, unit, ON, 2)); }
+	CHECK(q.depth() == 1);
+	CHECK(q.coalesced() == 3);
+	q.flush();
+	CHECK(writeCount == 5);
+	CHECK(writes[0].code == UNIT_1);
+	CHECK(writes[3].code == UNIT_4);
+	CHECK(writes[4].code == ON);
+	CHECK(q.sent(X10_PRIORITY_NORMAL) == 4);
+	CHECK(q.framesSent() == 10);
+}
+
+static void testNoOvertake(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	// A2 ON must not join A1 ON ahead of the A2 DIM
+	CHECK(q.add(HOUSE_A, 1, ON, 2));
+	CHECK(q.add(HOUSE_A, 2, DIM, 5));
+	CHECK(q.add(HOUSE_A, 2, ON, 2));
+	CHECK(q.depth() == 3);
+	CHECK(q.coalesced() == 0);
+	q.flush();
+	CHECK(writes[3].code == DIM);
+	CHECK(writes[5].code == ON);
+	// DIM address frames use addressRepeats, the function its step count
+	CHECK(writes[2].numRepeats == 2);
+	CHECK(writes[3].numRepeats == 5);
+}
+
+static void testRejectLeavesQueue(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	CHECK(q.add(HOUSE_A, 1, ON, 2, X10_PRIORITY_HIGH));
+	CHECK(q.add(HOUSE_A, 2, ON, 2, X10_PRIORITY_HIGH));
+	for (byte i = 1; i < X10_QUEUE_SIZE; i++) {
+		CHECK(q.add(houses[i], 1, ON, 2, X10_PRIORITY_HIGH));
+	}
+	CHECK(q.depth() == X10_QUEUE_SIZE);
+	CHECK(!q.add(HOUSE_A, 1, OFF, 2, X10_PRIORITY_HIGH));
+	CHECK(q.rejected() == 1);
+	CHECK(q.superseded() == 0);
+	CHECK(q.depth() == X10_QUEUE_SIZE);
+	q.service();
+	q.service();
+	q.service();
+	// A1 still gets its ON
+	CHECK(writeCount == 3);
+	CHECK(writes[0].code == UNIT_1);
+	CHECK(writes[1].code == UNIT_2);
+	CHECK(writes[2].code == ON);
+}
+
+static void testReplaceMakesRoom(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte i = 0; i < X10_QUEUE_SIZE; i++) {
+		CHECK(q.add(houses[i], 1, ON, 2, X10_PRIORITY_HIGH));
+	}
+	// replacing the only unit of an entry frees its slot
+	CHECK(q.add(HOUSE_A, 1, OFF, 2, X10_PRIORITY_HIGH));
+	CHECK(q.rejected() == 0);
+	CHECK(q.superseded() == 1);
+	CHECK(q.depth() == X10_QUEUE_SIZE);
+}
+
+static void testDisplace(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte i = 0; i < X10_QUEUE_SIZE; i++) {
+		CHECK(q.add(houses[i], 1, DIM, 10, X10_PRIORITY_LOW));
+	}
+	CHECK(!q.add(HOUSE_A, 2, DIM, 5, X10_PRIORITY_LOW));
+	CHECK(q.add(HOUSE_A, 16, ON, 2, X10_PRIORITY_HIGH));
+	CHECK(q.rejected() == 1);
+	CHECK(q.displaced() == 1);
+	q.service();
+	CHECK(writes[0].code == UNIT_16);
+}
+
+static void testBatchCap(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte unit = 1; unit <= 16; unit++) { CHECK(q.add(HOUSE_A, unit, ON, 2)); }
+	CHECK(q.depth() == 16 / X10_QUEUE_BATCH);
+	CHECK(q.coalesced() == 16 - 16 / X10_QUEUE_BATCH);
+	q.flush();
+	CHECK(writeCount == 16 + 16 / X10_QUEUE_BATCH);
+	CHECK(writes[X10_QUEUE_BATCH].code == ON);
+}
+
+static void testWholeHouse(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	// sending ALL_UNITS_OFF twice does nothing more than once
+	CHECK(q.add(HOUSE_A, 0, ALL_UNITS_OFF, 2));
+	CHECK(q.add(HOUSE_A, 0, ALL_UNITS_OFF, 2));
+	CHECK(q.depth() == 1);
+	CHECK(q.coalesced() == 1);
+	q.flush();
+	CHECK(writeCount == 1);
+
+	// but every DIM step counts
+	resetModem();
+	q.resetStats();
+	CHECK(q.add(HOUSE_A, 0, DIM, 3));
+	CHECK(q.add(HOUSE_A, 0, DIM, 3));
+	CHECK(q.depth() == 2);
+	CHECK(q.coalesced() == 0);
+	q.flush();
+	CHECK(writeCount == 2);
+	CHECK(writes[0].code == DIM && writes[1].code == DIM);
+	CHECK(q.framesSent() == 6);
+}
+
+static void testPreempt(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte unit = 1; unit <= X10_QUEUE_BATCH; unit++) {
+		CHECK(q.add(HOUSE_A, unit, ON, 2, X10_PRIORITY_LOW));
+	}
+	CHECK(q.service());
+	// another house goes ahead between address frames
+	CHECK(q.add(HOUSE_B, 16, OFF, 2, X10_PRIORITY_HIGH));
+	q.flush();
+	CHECK(q.preempted() == 1);
+	CHECK(writeCount == X10_QUEUE_BATCH + 1 + 2);
+	CHECK(writes[0].code == UNIT_1 && writes[0].houseCode == HOUSE_A);
+	CHECK(writes[1].code == UNIT_16 && writes[1].houseCode == HOUSE_B);
+	CHECK(writes[2].code == OFF && writes[2].houseCode == HOUSE_B);
+	CHECK(writes[3].code == UNIT_2 && writes[3].houseCode == HOUSE_A);
+	CHECK(writes[writeCount - 1].code == ON && writes[writeCount - 1].houseCode == HOUSE_A);
+	CHECK(q.maxWait(X10_PRIORITY_HIGH) == 0);
+}
+
+static void testSameHouseWaits(void)
+{
+	x10 modem;
+	x10queue q(modem);
+
+	resetModem();
+	for (byte unit = 1; unit <= X10_QUEUE_BATCH; unit++) {
+		CHECK(q.add(HOUSE_A, unit, ON, 2, X10_PRIORITY_LOW));
+	}
+	CHECK(q.service());
+	// A16 OFF now would also switch off the units already addressed
+	CHECK(q.add(HOUSE_A, 16, OFF, 2, X10_PRIORITY_HIGH));
+	q.flush();
+	CHECK(q.preempted() == 0);
+	CHECK(writes[X10_QUEUE_BATCH].code == ON);
+	CHECK(writes[X10_QUEUE_BATCH + 1].code == UNIT_16);
+	CHECK(writes[X10_QUEUE_BATCH + 2].code == OFF);
+}
+
+// Saturating load: the queue is kept full of low priority DIM ramps for
+// houses A-D, which merge into batches of X10_QUEUE_BATCH units, and a high
+// priority command for highHouse arrives as a write starts, every eighth
+// write so that it is the only one pending.
+
+static x10queue *loadQueue;
+static byte loadHouse;
+static int highQueued;
+static int nextHigh;
+
+static void injectHigh(void)
+{
+	if (nextHigh < 0) return;
+	if (loadQueue->add(loadHouse, 16, (nextHigh & 1) ? OFF : ON, 2, X10_PRIORITY_HIGH)) {
+		highQueued++;
+	}
+	nextHigh = -1;
+}
+
+static void testSaturated(byte highHouse, unsigned long bound, const char *name)
+{
+	x10 modem;
+	x10queue q(modem);
+	const int rounds = 1000;
+	int lowAdded = 0;
+
+	resetModem();
+	loadQueue = &q;
+	loadHouse = highHouse;
+	highQueued = 0;
+	onWrite = injectHigh;
+	for (int round = 0; round < rounds; round++) {
+		// top the queue up with bulk traffic
+		for (int i = 0; q.depth() < X10_QUEUE_SIZE; i++) {
+			int n = lowAdded + i;
+			if (q.add(houses[n % 4], 1 + n / 4 % 16, DIM, 10, X10_PRIORITY_LOW)) {
+				lowAdded++;
+			}
+		}
+		CHECK(q.depth() == X10_QUEUE_SIZE);
+		nextHigh = (round % 8 == 0) ? round : -1;
+		q.service();
+	}
+	onWrite = 0;
+	q.flush();
+
+	unsigned long units = q.sent(X10_PRIORITY_LOW) + q.sent(X10_PRIORITY_HIGH);
+	unsigned long expected = units * 2 + wireDimWrites * 10 + q.sent(X10_PRIORITY_HIGH) * 2;
+
+	printf("saturated, %s: %lu frames, %lu coalesced, %lu preempted, %lu high sent, "
+		"high wait max %lu ms avg %lu ms (bound %lu), low wait max %lu ms\n",
+		name, q.framesSent(), q.coalesced(), q.preempted(), q.sent(X10_PRIORITY_HIGH),
+		q.maxWait(X10_PRIORITY_HIGH), q.avgWait(X10_PRIORITY_HIGH), bound,
+		q.maxWait(X10_PRIORITY_LOW));
+
+	CHECK(q.maxDepth() == X10_QUEUE_SIZE);
+	CHECK(q.coalesced() > 0);
+	CHECK(highQueued == (rounds + 7) / 8);
+	CHECK(q.sent(X10_PRIORITY_HIGH) == (unsigned long)highQueued);
+	CHECK(q.sent(X10_PRIORITY_LOW) == (unsigned long)(lowAdded - q.displaced()));
+	CHECK(wireAddressFrames == units * 2);
+	CHECK(q.framesSent() == expected);
+	CHECK(q.framesSent() == wireFrames);
+	CHECK(q.maxWait(X10_PRIORITY_HIGH) <= bound);
+	CHECK(q.maxWait(X10_PRIORITY_HIGH) < q.maxWait(X10_PRIORITY_LOW));
+}
+
+int main(void)
+{
+	testSupersede();
+	testCoalesce();
+	testNoOvertake();
+	testRejectLeavesQueue();
+	testReplaceMakesRoom();
+	testDisplace();
+	testBatchCap();
+	testWholeHouse();
+	testPreempt();
+	testSameHouseWaits();
+
+	// longest single write is the ten step DIM
+	const unsigned long writeMs = 10 * FRAME_MS;
+	// a whole batch is its address writes and that DIM
+	const unsigned long batchMs = X10_QUEUE_BATCH * (2 * FRAME_MS + GAP_MS) + writeMs;
+	testSaturated(HOUSE_P, writeMs, "other house");
+	testSaturated(HOUSE_A, batchMs, "same house");
+	if (failures) {
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("x10queue: all tests passed\n");
+	return 0;
+}
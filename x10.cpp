@@ -38,10 +38,9 @@
 #include "x10.h"
 #include "x10constants.h"
 #include "psc05.h"
+#include "x10codec.h"
 
-volatile unsigned long mask;           // MSB first - bit 12 - bit 0
-volatile unsigned int X10BitCnt; // counts bit sequence in frame
-volatile unsigned int ZCrossCnt;   // counts Z crossings in frame
+x10_rx rxState;                        // receive decoder state
 volatile unsigned long rcveBuff;       // holds the 13 bits received in a frame
 volatile boolean X10rcvd;      // true if a new frame has been received
 boolean _newX10;         // both the unit frame and the command frame received
@@ -83,8 +82,7 @@ void x10::init(int zeroCrossingPin, int dataPin, int rp, int led)
 	if (this->recvPin>0) {
 		pinMode(this->recvPin,INPUT_PULLUP);             // receive X10 commands - low = 1 - INPUT_PULLUP sets 20K pullup (low active signal)
 		attachInterrupt(digitalPinToInterrupt(this->zeroCrossingPin),x10_Check_Rcvr_wrapper,CHANGE);// trigger zero cross
-		X10BitCnt=0; // counts bit sequence in frame
-		ZCrossCnt=0;   // counts Z crossings in frame
+		x10_rxReset(&rxState); // no frame in progress
 		X10rcvd=false;      // true if a new frame has been received
 		_newX10=false;         // both the unit frame and the command frame received
 	}
@@ -168,14 +166,12 @@ void x10::detectMainsFreq() {
 	Writes an X10 command out to the X10 modem
 */
 void x10::write(byte houseCode, byte numberCode, int numRepeats) {
-  byte startCode = B1110; 		// every X10 command starts with this
+  uint32_t frame = x10_encodeFrame(houseCode, numberCode);
   if (this->recvPin>0) { detachInterrupt(digitalPinToInterrupt(this->zeroCrossingPin)); }
   // repeat as many times as requested:
   for (int i = 0; i < numRepeats; i++) {
-  	// send the three parts of the command:
-  	sendBits(startCode, 4, true);	
-    	sendBits(houseCode, 4, false);
-    	sendBits(numberCode, 5, false);
+  	// send start code, house code and unit or function:
+  	sendBits(frame, X10_FRAME_HALF_CYCLES);
     }
     // if this isn't a bright or dim command, it should be followed by
     // a delay of 3 power cycles (or 6 zero crossings):
@@ -185,19 +181,18 @@ void x10::write(byte houseCode, byte numberCode, int numRepeats) {
   if (this->recvPin>0) { attachInterrupt(digitalPinToInterrupt(this->zeroCrossingPin),x10_Check_Rcvr_wrapper,CHANGE); } // trigger zero cross
 }
 /*
-	Writes a sequence of bits out.  If the sequence is not a start code,
-	it repeats the bits, inverting them.
+	Writes a sequence of half cycles out, most significant first, as
+	produced by x10_encodeFrame().
 */
 
-void x10::sendBits(byte cmd, byte numBits, byte isStartCode) {
-  byte thisBit;		// copy of command so we can shift bits
+void x10::sendBits(uint32_t halfCycles, byte numHalfCycles) {
+  byte thisBit;		// value for this half cycle
   
-	// iterate the number of bits to be shifted:
-	for(int i=1; i<=numBits; i++) {
+	// iterate the number of half cycles to be sent:
+	for(int i=numHalfCycles-1; i>=0; i--) {
 		// wait for a zero crossing change:
 		waitForZeroCross(this->zeroCrossingPin, 1);
-		// shift off the last bit of the command:
-		thisBit = !!(cmd & (1 << (numBits - i)));
+		thisBit = (halfCycles >> i) & 1;
 		
 		// repeat once for each phase:
 		for (int phase = 0; phase < 3; phase++) {
@@ -210,23 +205,6 @@ void x10::sendBits(byte cmd, byte numBits, byte isStartCode) {
 			// This was we can be a bit more accurate (slighlty more delay between phases) without missing zero cross.
 			if(phase < 2) { delayMicroseconds(this->bitDelay); }
 		}
-		
-		// if this command is a start code, don't
-		// send its complement.  Otherwise do:
-		if(!isStartCode) {
-			// wait for zero crossing:
-			waitForZeroCross(zeroCrossingPin, 1);
-			for (int phase = 0; phase < 3; phase++) {
-				// set the data pin:
-				digitalWrite(this->dataPin, !thisBit);
-				delayMicroseconds(this->bitLength);
-				// clear the data pin:
-				digitalWrite(dataPin, LOW);
-				// Only delay between first to phases as final delay is what ever is left before zero cross.
-				// This was we can be a bit more accurate (slighlty more delay between phases) without missing zero cross.
-				if(phase < 2) { delayMicroseconds(this->bitDelay); }
-			}
-		}
 	}
 }
 
@@ -323,45 +301,29 @@ byte x10::cmndCode(void)
 }
 
 void x10::Check_Rcvr(){    // ISR - called when zero crossing (on CHANGE)
-  if (X10BitCnt == 0) {                // looking for new frame
-    delayMicroseconds(this->offsetDelay);   // wait for bit
-    if(digitalRead(this->recvPin)) return;  // still high - no start bit - get out
-    if (this->ledPin>0) { digitalWrite(this->ledPin, HIGH); }     // indicate you got something
-    rcveBuff = 0;
-    mask = 0x1000;                     // bitmask with bit 12 set
-    rcveBuff = rcveBuff | mask;        // sets bit 12 (highest)
-    mask = mask >> 1;                  // move bit down in bit mask
-    X10BitCnt = 1;                     // inc the bit count
-    ZCrossCnt = 1;                     // need to count zero crossings too
-    return;
+  if (!x10_rxZeroCross(&rxState)) return;   // complement half cycle - skip it
+  boolean idle = (rxState.bits == 0);
+  delayMicroseconds(this->offsetDelay);     // wait for bit
+  boolean done = x10_rxSample(&rxState, !digitalRead(this->recvPin)); // low = carrier
+  if (idle != (rxState.bits == 0) && this->ledPin>0) {
+    digitalWrite(this->ledPin, idle ? HIGH : LOW);  // indicate you got something
   }
-  // Begins here if NOT the first bit . . .
-  ZCrossCnt++;                         // inc the zero crossing count
-  // after SC (first 4 bits) ignore the pariety bits - so only read odd crossings
-  if (X10BitCnt < 5 || (ZCrossCnt & 0x01)){ // if it's an odd # zero crossing
-    delayMicroseconds(this->offsetDelay);   // wait for bit
-    if(!digitalRead(this->recvPin)) rcveBuff = rcveBuff | mask;  // got a 1 set the bit, else skip and leave it 0
-    mask = mask >> 1;                  // move bit down in bit mask
-    X10BitCnt++;
-
-    if(X10BitCnt == 13){               // done with frame after 13 bits
-      for (byte i=0;i<5;i++)delayMicroseconds(this->halfCycleDelay); // need this
-      X10rcvd = true;                  // a new frame has been received
-      if (this->ledPin>0) { digitalWrite(this->ledPin, LOW); }     // indicate you got something
-      X10BitCnt = 0;
-      x10_Parse_Frame_wrapper();                   // parse out the house & unit code and command
-    }
+  if (done) {
+    for (byte i=0;i<5;i++)delayMicroseconds(this->halfCycleDelay); // need this
+    rcveBuff = rxState.frame;
+    X10rcvd = true;                    // a new frame has been received
+    x10_Parse_Frame_wrapper();         // parse out the house & unit code and command
   }
 }
 
 #if 1
 void x10::Parse_Frame() {   // parses the receive buffer to get House, Unit, and Cmnd
-  if(rcveBuff & 0x1){                  // last bit set so it's a command
-    _cmndCode = rcveBuff & 0x1F;        // mask 5 bits 0 - 4 to get the command
+  if(x10_frameIsFunction(rcveBuff)){  // last bit set so it's a command
+    _cmndCode = x10_frameCode(rcveBuff); // mask 5 bits 0 - 4 to get the command
     _newX10 = true;                     // now have complete pair of frames
   }
   else {                               // last bit not set so it's a unit
-    _unitCode = rcveBuff & 0x1F;        // mask 5 bits 0 - 4 to get the unit
+    _unitCode = x10_frameCode(rcveBuff); // mask 5 bits 0 - 4 to get the unit
     _uc = _unitCode;
     _newX10 = false;                    // now wait for the command
     for (byte i=0; i<16; i++){         // use lookup table to get the actual unit #
@@ -371,8 +333,7 @@ void x10::Parse_Frame() {   // parses the receive buffer to get House, Unit, and
       }
     }
   }
-  rcveBuff = rcveBuff >> 5;            // shift the house code down to LSB
-  _houseCode = rcveBuff & 0x0F;         // mask the last 4 bits to get the house code
+  _houseCode = x10_frameHouse(rcveBuff); // bits 5 - 8 are the house code
   _hc = _houseCode;
   for (byte i=0; i<16; i++){           // use lookup table to get the actual command #
     if (House[i] == _houseCode){ 
@@ -380,8 +341,7 @@ void x10::Parse_Frame() {   // parses the receive buffer to get House, Unit, and
       break;                           // stop search when found!
     }
   }
-  rcveBuff = rcveBuff >> 4;            // shift the start code down to LSB
-  startCode = rcveBuff & 0x0F;         // mask the last 4 bits to get the start code
+  startCode = x10_frameStart(rcveBuff); // bits 9 - 12 are the start code
   X10rcvd = false;                     // reset status
 }
 #else
@@ -64,8 +64,8 @@ class x10 {
     int dataPin;			// data out pin
 	int recvPin;			// Receive data pin
 	int ledPin;				// LED pin
-    // sends the individual bits of the commands:
-    void sendBits(byte cmd, byte numBits, byte isStartCode);
+    // sends the half cycles of an encoded frame:
+    void sendBits(uint32_t halfCycles, byte numHalfCycles);
     // checks for AC zero crossing
     void waitForZeroCross(int pin, int howManyTimes);
 };
@@ -0,0 +1,93 @@
+/*
+  x10codec.cpp - Bit level X10 frame encoder and decoder.
+
+	The decoder follows the original receive ISR: after the start bit only
+	the odd zero crossings past the start code are sampled, the complement
+	half cycles are skipped.
+*/
+
+#include "x10codec.h"
+
+uint32_t x10_encodeFrame(uint8_t houseCode, uint8_t code)
+{
+	uint32_t halfCycles = 0;
+	int8_t i;
+
+	// start code is sent without complements:
+	for (i = 3; i >= 0; i--) {
+		halfCycles = (halfCycles << 1) | ((X10_START_CODE >> i) & 1);
+	}
+	// every other bit is followed by its complement:
+	for (i = 3; i >= 0; i--) {
+		uint8_t bit = (houseCode >> i) & 1;
+		halfCycles = (halfCycles << 2) | (bit << 1) | (bit ^ 1);
+	}
+	for (i = 4; i >= 0; i--) {
+		uint8_t bit = (code >> i) & 1;
+		halfCycles = (halfCycles << 2) | (bit << 1) | (bit ^ 1);
+	}
+	return halfCycles;
+}
+
+void x10_rxReset(x10_rx *rx)
+{
+	rx->frame = 0;
+	rx->bits = 0;
+	rx->zeroCrossings = 0;
+	rx->skip = 0;
+}
+
+bool x10_rxZeroCross(x10_rx *rx)
+{
+	if (rx->skip) {						// trailing complement of a frame
+		rx->skip--;
+		return false;
+	}
+	if (rx->bits == 0) return true;		// looking for a start bit
+	rx->zeroCrossings++;
+	// after the start code skip the complement half cycles
+	return rx->bits < 5 || (rx->zeroCrossings & 0x01);
+}
+
+bool x10_rxSample(x10_rx *rx, bool carrier)
+{
+	if (rx->bits == 0) {
+		if (!carrier) return false;		// no start bit
+		rx->frame = 1 << (X10_FRAME_BITS - 1);
+		rx->bits = 1;
+		rx->zeroCrossings = 1;
+		return false;
+	}
+	if (carrier) { rx->frame |= 1 << (X10_FRAME_BITS - 1 - rx->bits); }
+	rx->bits++;
+	if (rx->bits == 4 && x10_frameStart(rx->frame) != X10_START_CODE) {
+		rx->bits = 0;					// noise - wait for the next start bit
+		return false;
+	}
+	if (rx->bits == X10_FRAME_BITS) {
+		rx->bits = 0;					// done with frame after 13 bits
+		rx->skip = 1;					// its last complement is still to come
+		return true;
+	}
+	return false;
+}
+
+uint8_t x10_frameStart(uint16_t frame)
+{
+	return (frame >> 9) & 0x0F;
+}
+
+uint8_t x10_frameHouse(uint16_t frame)
+{
+	return (frame >> 5) & 0x0F;
+}
+
+uint8_t x10_frameCode(uint16_t frame)
+{
+	return frame & 0x1F;
+}
+
+bool x10_frameIsFunction(uint16_t frame)
+{
+	return frame & 0x01;
+}
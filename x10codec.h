@@ -0,0 +1,51 @@
+/*
+	x10codec.h - Bit level X10 frame encoder and decoder.
+
+	Pure functions with no pin or timer access so that they can be built
+	and exercised off target.  x10::write() and x10::Check_Rcvr() drive
+	the pins and call these to work out what to send and what was heard.
+
+	A frame is 13 bits, MSB first: start code (4), house code (4) and
+	unit or function code (5).  The last bit is set for a function.
+	On the wire the start code is sent as is and every other bit is
+	followed by its complement, giving 22 half cycles.
+*/
+
+#ifndef x10codec_h
+#define x10codec_h
+
+#include <stdint.h>
+
+#define X10_START_CODE			0x0E	// B1110
+#define X10_FRAME_BITS			13
+#define X10_FRAME_HALF_CYCLES	22
+
+// Receive state, one per receiver.
+struct x10_rx {
+	uint16_t frame;			// bits received so far, MSB first
+	uint8_t bits;			// bits received, 0 = waiting for a start bit
+	uint8_t zeroCrossings;	// zero crossings since the start bit
+	uint8_t skip;			// half cycles to ignore before the next start bit
+};
+
+// Returns the half cycles for a frame, first one in bit 21.
+uint32_t x10_encodeFrame(uint8_t houseCode, uint8_t code);
+
+void x10_rxReset(x10_rx *rx);
+// Call at every zero crossing.  Returns true if the carrier should be
+// sampled for this half cycle, false for a complement half cycle.  This
+// includes the last half cycle of a frame, the complement of its final
+// bit, so it is not taken for the start bit of a following repeat.
+bool x10_rxZeroCross(x10_rx *rx);
+// Feed the sample for a half cycle that x10_rxZeroCross() asked for.
+// Returns true when a complete frame is in rx->frame.  A frame that does
+// not begin with the start code is dropped after its fourth bit.
+bool x10_rxSample(x10_rx *rx, bool carrier);
+
+// Split a received frame into its parts.
+uint8_t x10_frameStart(uint16_t frame);
+uint8_t x10_frameHouse(uint16_t frame);
+uint8_t x10_frameCode(uint16_t frame);
+bool x10_frameIsFunction(uint16_t frame);
+
+#endif
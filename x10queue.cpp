@@ -0,0 +1,301 @@
+/*
+  x10queue.cpp - Prioritised transmit queue for the X10 library.
+
+	Commands are kept in arrival order in a fixed table.  service() starts
+	the oldest command of the most urgent priority and writes its address
+	frames and then its function frame with x10::write(), one per call.
+	If a more urgent command for another house arrives meanwhile, it is
+	started on top and the paused batch resumes once it is done.
+
+	Adding a command for a unit:
+	-	Walks back from the newest pending command to the last one that
+		addresses the same unit.  If that is an ON or OFF and the new
+		command is an ON or OFF, the unit is dropped from it (superseded).
+	-	Walks back through pending commands of the same priority and house.
+		If one has the same function and repeat count the unit is merged
+		into it, unless a command in between addresses the same unit,
+		which would then be overtaken, or the batch is already
+		X10_QUEUE_BATCH units.  Whole house commands are only merged when
+		sending them twice does nothing more than sending them once.
+
+	If the queue is full, a more urgent command displaces the newest
+	command of the least urgent priority.  Otherwise it is rejected and
+	the queue is left untouched.
+*/
+
+#include <stdlib.h>
+#include "Arduino.h"
+#include "x10.h"
+#include "x10queue.h"
+#include "x10constants.h"
+
+// True if a whole house command can be sent once for two requests.
+static boolean idempotent(byte cmndCode)
+{
+	return cmndCode == ALL_UNITS_OFF || cmndCode == ALL_LIGHTS_ON || cmndCode == ALL_LIGHTS_OFF;
+}
+
+static const byte unitCodes[16] = {	// binary unit code for units 1-16
+	UNIT_1,  UNIT_2,  UNIT_3,  UNIT_4,
+	UNIT_5,  UNIT_6,  UNIT_7,  UNIT_8,
+	UNIT_9,  UNIT_10, UNIT_11, UNIT_12,
+	UNIT_13, UNIT_14, UNIT_15, UNIT_16
+};
+
+x10queue::x10queue(x10 &modem)
+{
+	this->modem = &modem;
+	this->addressRepeats = 2;
+	this->count = 0;
+	this->activeCount = 0;
+	resetStats();
+}
+
+boolean x10queue::add(byte houseCode, byte unit, byte cmndCode, int numRepeats)
+{
+	return add(houseCode, unit, cmndCode, numRepeats, X10_PRIORITY_NORMAL);
+}
+
+boolean x10queue::add(byte houseCode, byte unit, byte cmndCode, int numRepeats, byte priority)
+{
+	unsigned int bit = 0;	// unit as a mask bit, 0 for the whole house
+	unsigned int mask;
+	int replaced = -1;		// pending ON/OFF this command replaces
+	int merged = -1;		// pending command this one joins
+	int victim = -1;		// pending command displaced to make room
+	int i;
+
+	if (unit > 16) return false;
+	if (priority >= X10_PRIORITY_LEVELS) priority = X10_PRIORITY_LOW;
+	if (unit > 0) bit = 1U << (unit - 1);
+
+	// Nothing is changed until the command is known to be accepted.
+
+	// An ON or OFF replaces an unsent ON or OFF for the same unit:
+	if (bit && (cmndCode == ON || cmndCode == OFF)) {
+		for (i = this->count - 1; i >= 0; i--) {
+			entry &e = this->pending[i];
+			if (e.houseCode != houseCode) continue;
+			if (e.unitMask != 0 && !(e.unitMask & bit)) continue;
+			// this is the last command to reach the unit
+			if (e.unitMask != 0 && (e.cmndCode == ON || e.cmndCode == OFF)) { replaced = i; }
+			break;
+		}
+	}
+
+	// Merge into a pending command with the same house and function:
+	for (i = this->count - 1; i >= 0; i--) {
+		entry &e = this->pending[i];
+		if (e.houseCode != houseCode || e.priority != priority) continue;
+		mask = e.unitMask;
+		if (i == replaced) {
+			mask &= ~bit;
+			if (mask == 0) continue;	// will be removed
+		}
+		if (e.cmndCode == cmndCode && e.numRepeats == numRepeats &&
+				(bit ? (mask != 0 && !(mask & bit) && unitCount(mask) < X10_QUEUE_BATCH)
+					: (mask == 0 && idempotent(cmndCode)))) {
+			merged = i;
+			break;
+		}
+		// stop at a command that also reaches this unit
+		if (bit == 0 || mask == 0 || (mask & bit)) break;
+	}
+
+	if (merged < 0 && this->count + this->activeCount >= X10_QUEUE_SIZE &&
+			!(replaced >= 0 && this->pending[replaced].unitMask == bit)) {
+		// displace the newest of the least urgent commands if it is less
+		// urgent than this one
+		for (i = this->count - 1; i >= 0; i--) {
+			if (victim < 0 || this->pending[i].priority > this->pending[victim].priority) {
+				victim = i;
+			}
+		}
+		if (this->pending[victim].priority <= priority) {
+			this->rejectedCount++;
+			return false;
+		}
+	}
+
+	// Accepted, apply the changes:
+	if (merged >= 0) {
+		this->pending[merged].unitMask |= bit;
+		this->coalescedCount++;
+	}
+	if (replaced >= 0 && replaced != merged) {
+		this->pending[replaced].unitMask &= ~bit;
+		this->supersededCount++;
+		if (this->pending[replaced].unitMask == 0) { remove(replaced); }
+	}
+	if (merged >= 0) return true;
+	if (victim >= 0) {
+		this->displacedCount += unitCount(this->pending[victim].unitMask);
+		remove(victim);
+	}
+
+	entry &e = this->pending[this->count++];
+	e.houseCode = houseCode;
+	e.cmndCode = cmndCode;
+	e.priority = priority;
+	e.numRepeats = numRepeats;
+	e.unitMask = bit;
+	e.queuedAt = millis();
+	if (depth() > this->highWater) { this->highWater = depth(); }
+	return true;
+}
+
+boolean x10queue::service(void)
+{
+	int next = -1;
+	byte i, j;
+
+	// Oldest command of the most urgent priority.  While a batch is on the
+	// wire only a more urgent command for a house with no batch started
+	// can go ahead of it.
+	for (i = 0; i < this->count; i++) {
+		entry &e = this->pending[i];
+		if (next >= 0 && e.priority >= this->pending[next].priority) continue;
+		if (this->activeCount > 0) {
+			if (e.priority >= this->active[this->activeCount - 1].priority) continue;
+			for (j = 0; j < this->activeCount; j++) {
+				if (this->active[j].houseCode == e.houseCode) break;
+			}
+			if (j < this->activeCount) continue;
+		}
+		next = i;
+	}
+	if (next >= 0) {
+		if (this->activeCount > 0) { this->preemptedCount++; }
+		entry &e = this->active[this->activeCount];
+		e = this->pending[next];
+		this->unitsLeft[this->activeCount] = e.unitMask;
+		this->activeCount++;
+		remove(next);
+
+		// wait is measured from the oldest command merged into the entry
+		unsigned long waited = millis() - e.queuedAt;
+		byte commands = unitCount(e.unitMask);
+		this->sentCount[e.priority] += commands;
+		this->waitTotal[e.priority] += waited * commands;
+		if (waited > this->waitMax[e.priority]) { this->waitMax[e.priority] = waited; }
+	}
+	if (this->activeCount == 0) return false;
+
+	byte top = this->activeCount - 1;
+	entry e = this->active[top];
+	if (this->unitsLeft[top] != 0) {
+		int repeats = e.numRepeats;
+		if (e.cmndCode == DIM || e.cmndCode == BRIGHT) { repeats = this->addressRepeats; }
+		for (i = 0; !(this->unitsLeft[top] & (1U << i)); i++) { }
+		this->unitsLeft[top] &= ~(1U << i);
+		this->modem->write(e.houseCode, unitCodes[i], repeats);
+		this->frameCount += repeats;
+		return true;
+	}
+	this->activeCount--;
+	this->modem->write(e.houseCode, e.cmndCode, e.numRepeats);
+	this->frameCount += e.numRepeats;
+	return true;
+}
+
+void x10queue::flush(void)
+{
+	while (service()) { }
+}
+
+void x10queue::clear(void)
+{
+	this->count = 0;
+}
+
+void x10queue::remove(byte index)
+{
+	for (byte i = index + 1; i < this->count; i++) {
+		this->pending[i - 1] = this->pending[i];
+	}
+	this->count--;
+}
+
+// Commands held by an entry: one per unit, or one for a whole house command.
+byte x10queue::unitCount(unsigned int unitMask)
+{
+	byte n = 0;
+
+	if (unitMask == 0) return 1;
+	for (; unitMask; unitMask >>= 1) { n += unitMask & 1; }
+	return n;
+}
+
+byte x10queue::depth(void)
+{
+	return this->count + this->activeCount;
+}
+
+byte x10queue::maxDepth(void)
+{
+	return this->highWater;
+}
+
+unsigned long x10queue::framesSent(void)
+{
+	return this->frameCount;
+}
+
+unsigned long x10queue::superseded(void)
+{
+	return this->supersededCount;
+}
+
+unsigned long x10queue::coalesced(void)
+{
+	return this->coalescedCount;
+}
+
+unsigned long x10queue::rejected(void)
+{
+	return this->rejectedCount;
+}
+
+unsigned long x10queue::displaced(void)
+{
+	return this->displacedCount;
+}
+
+unsigned long x10queue::preempted(void)
+{
+	return this->preemptedCount;
+}
+
+unsigned long x10queue::sent(byte priority)
+{
+	if (priority >= X10_PRIORITY_LEVELS) return 0;
+	return this->sentCount[priority];
+}
+
+unsigned long x10queue::maxWait(byte priority)
+{
+	if (priority >= X10_PRIORITY_LEVELS) return 0;
+	return this->waitMax[priority];
+}
+
+unsigned long x10queue::avgWait(byte priority)
+{
+	if (priority >= X10_PRIORITY_LEVELS || this->sentCount[priority] == 0) return 0;
+	return this->waitTotal[priority] / this->sentCount[priority];
+}
+
+void x10queue::resetStats(void)
+{
+	this->highWater = depth();
+	this->frameCount = 0;
+	this->supersededCount = 0;
+	this->coalescedCount = 0;
+	this->rejectedCount = 0;
+	this->displacedCount = 0;
+	this->preemptedCount = 0;
+	for (byte i = 0; i < X10_PRIORITY_LEVELS; i++) {
+		this->sentCount[i] = 0;
+		this->waitMax[i] = 0;
+		this->waitTotal[i] = 0;
+	}
+}
@@ -0,0 +1,112 @@
+/*
+	x10queue.h - Prioritised transmit queue for the X10 library.
+
+	Holds outbound commands in a fixed size table (no heap allocation) and
+	sends them through an x10 instance in priority order.  Within a priority
+	level, pending commands that share a house code, function and repeat
+	count are coalesced so that several address frames are followed by a
+	single function frame, and an ON or OFF for a unit replaces any ON or
+	OFF for the same unit that has not been sent yet.
+
+	A batch is an entry's address frames and the function frame that acts
+	on them.  service() writes one frame per call.  Between frames of a
+	batch it hands the line to a more urgent command for another house.  A
+	more urgent command for the same house has to wait for the batch to
+	finish, because its function frame would also act on the units already
+	addressed.  Once it is the most urgent pending command, a command waits
+	at most for:
+	-	the write() on the wire, if it is for another house, or
+	-	the rest of the batch, if it is for the same house.  That is up to
+		X10_QUEUE_BATCH address writes and one function write.
+	On top of that comes the time between service() calls.
+
+	The queue is not interrupt safe - call add() and service() from loop().
+*/
+
+// ensure this library description is only included once
+#ifndef x10queue_h
+#define x10queue_h
+
+#include <stdlib.h>
+#include "Arduino.h"
+#include "x10.h"
+
+// Number of entries that can be pending at once, including batches
+// being sent.
+#define X10_QUEUE_SIZE 16
+// Most units merged into one batch.
+#define X10_QUEUE_BATCH 4
+
+// Priority levels, lower number is sent first.
+#define X10_PRIORITY_HIGH	0
+#define X10_PRIORITY_NORMAL	1
+#define X10_PRIORITY_LOW	2
+#define X10_PRIORITY_LEVELS	3
+
+// library interface description
+class x10queue {
+  public:
+    // constructors:
+	x10queue(x10 &modem);
+	// queue a command - unit is 1-16, or 0 for a command that applies to the
+	// whole house (ALL_UNITS_OFF, ALL_LIGHTS_ON etc).  Returns false if full.
+	boolean add(byte houseCode, byte unit, byte cmndCode, int numRepeats, byte priority);
+	boolean add(byte houseCode, byte unit, byte cmndCode, int numRepeats);
+	// writes the next frame, returns false if there was nothing to send
+	boolean service(void);
+	// sends everything that is pending
+	void flush(void);
+	// drops pending commands, batches already started are finished
+	void clear(void);
+	// statistics - a command is one unit, or one whole house command, so a
+	// merged entry counts once for each unit it addresses:
+	byte depth(void);				// entries pending or being sent
+	byte maxDepth(void);			// highest depth seen
+	unsigned long framesSent(void);	// frames on the wire, repeats included
+	unsigned long superseded(void);	// commands dropped by a later ON/OFF
+	unsigned long coalesced(void);	// commands merged into a pending one
+	unsigned long rejected(void);	// commands refused because queue full
+	unsigned long displaced(void);	// commands dropped for a more urgent one
+	unsigned long preempted(void);	// batches paused for a more urgent one
+	unsigned long sent(byte priority);		// commands sent at this priority
+	// Wait times are from when the oldest command of an entry was queued
+	// to when its first frame is written.
+	unsigned long maxWait(byte priority);	// worst queued time in ms
+	unsigned long avgWait(byte priority);	// mean queued time in ms
+	void resetStats(void);
+	// Repeats used for address frames.  DIM and BRIGHT use their repeat
+	// count as a step count, so their address frames are sent this many
+	// times instead.
+	int addressRepeats;
+  private:
+	struct entry {
+		byte houseCode;				// binary house code (x10constants.h)
+		byte cmndCode;				// binary function code (x10constants.h)
+		byte priority;
+		int numRepeats;
+		unsigned int unitMask;		// bit n set for unit n+1, 0 = whole house
+		unsigned long queuedAt;		// millis() of the oldest merged command
+	};
+	x10 *modem;
+	entry pending[X10_QUEUE_SIZE];	// in arrival order
+	byte count;
+	// batches being sent, the last one is on the wire and each one is more
+	// urgent than the one before
+	entry active[X10_PRIORITY_LEVELS];
+	unsigned int unitsLeft[X10_PRIORITY_LEVELS];	// addresses still to send
+	byte activeCount;
+	byte highWater;
+	unsigned long frameCount;
+	unsigned long supersededCount;
+	unsigned long coalescedCount;
+	unsigned long rejectedCount;
+	unsigned long displacedCount;
+	unsigned long preemptedCount;
+	unsigned long sentCount[X10_PRIORITY_LEVELS];
+	unsigned long waitMax[X10_PRIORITY_LEVELS];
+	unsigned long waitTotal[X10_PRIORITY_LEVELS];
+	void remove(byte index);
+	byte unitCount(unsigned int unitMask);
+};
+
+#endif